@@ -1,4 +1,4 @@
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -11,13 +11,23 @@ CONFIG += c++17
 SOURCES += \
     audioplayer.cpp \
     form.cpp \
+    librarymodel.cpp \
+    loudnessmeter.cpp \
+    loudnessscanner.cpp \
     main.cpp \
-    dialog.cpp
+    dialog.cpp \
+    medialibrary.cpp \
+    pcmformat.cpp
 
 HEADERS += \
     audioplayer.h \
     dialog.h \
-    form.h
+    form.h \
+    librarymodel.h \
+    loudnessmeter.h \
+    loudnessscanner.h \
+    medialibrary.h \
+    pcmformat.h
 
 FORMS += \
     dialog.ui \
@@ -1,5 +1,11 @@
 #include "audioplayer.h"
 
+#include <algorithm>
+#include <cmath>
+
+#include <QFile>
+
+
 bool AudioPlayer::startRecord(UINT nChannel, UINT bitDepth, UINT sampleRate, UINT deviceID){
     // 0. 记录开始时间
     this->startTime = QTime::currentTime();
@@ -12,6 +18,7 @@ bool AudioPlayer::startRecord(UINT nChannel, UINT bitDepth, UINT sampleRate, UIN
     waveFormat.nBlockAlign = waveFormat.nChannels * waveFormat.wBitsPerSample / 8;  // 每个采样块的字节数
     waveFormat.nAvgBytesPerSec = waveFormat.nSamplesPerSec * waveFormat.nBlockAlign; // 每秒的平均字节数
     waveFormat.cbSize = 0;                    // 无附加信息
+    this->recordFormat = waveFormat;
 
     // 2. 打开音频设备, 同时传递对象指针, 方便回调函数使用
     if (waveInOpen(&this->hWaveIn, deviceID, &waveFormat,
@@ -38,6 +45,17 @@ bool AudioPlayer::startRecord(UINT nChannel, UINT bitDepth, UINT sampleRate, UIN
     // 4. 写入wav文件头
     wirteWaveHeader(sampleRate, bitDepth, nChannel);
 
+    // 实时响度表, 格式不支持解码时不测量
+    {
+        std::lock_guard<std::mutex> lock(this->meterMutex);
+        if (PcmFormat::isSupported(WAVE_FORMAT_PCM, bitDepth)) {
+            this->recordMeter = std::make_unique<LoudnessMeter>(sampleRate, nChannel);
+            this->recordSamples.reserve(this->recordBlockSize / (bitDepth / 8));
+        } else {
+            this->recordMeter.reset();
+        }
+    }
+
     // 5. 开始录制
     if (waveInStart(this->hWaveIn) != MMSYSERR_NOERROR) {
         qDebug() << "Failed to start record";
@@ -114,6 +132,7 @@ void CALLBACK AudioPlayer::waveInProc(
         // 写入数据到文件
         audioplayer->recordBuffer.insert(audioplayer->recordBuffer.end(),
                                          waveHeader->lpData, waveHeader->lpData + waveHeader->dwBytesRecorded);
+        audioplayer->measureRecord(waveHeader->lpData, waveHeader->dwBytesRecorded);
         // 解决死锁, 详见waveInReset调用处
         if (audioplayer->isRecording) {
             waveInAddBuffer(hwi, waveHeader, sizeof(WAVEHDR)); //buffer重新放入采集队列
@@ -149,6 +168,29 @@ void AudioPlayer::clearData(){
     this->recordBuffer.clear();
 }
 
+bool AudioPlayer::recordLoudness(double& momentary, double& shortTerm, double& integrated, double& truePeak){
+    std::lock_guard<std::mutex> lock(this->meterMutex);
+    if (!this->isRecording || this->recordMeter == nullptr) {
+        return false;
+    }
+    momentary = this->recordMeter->momentary();
+    shortTerm = this->recordMeter->shortTerm();
+    integrated = this->recordMeter->integrated();
+    truePeak = this->recordMeter->truePeak();
+    return true;
+}
+
+void AudioPlayer::measureRecord(const char* data, DWORD bytes){
+    std::lock_guard<std::mutex> lock(this->meterMutex);
+    if (this->recordMeter == nullptr) {
+        return;
+    }
+    this->recordSamples.resize(bytes / (this->recordFormat.wBitsPerSample / 8));
+    size_t count = PcmFormat::decodeSamples(data, bytes, WAVE_FORMAT_PCM,
+                                            this->recordFormat.wBitsPerSample, this->recordSamples.data());
+    this->recordMeter->addFrames(this->recordSamples.data(), count / this->recordFormat.nChannels);
+}
+
 void AudioPlayer::wirteWaveHeader(UINT sampleRate, UINT bitDepth, UINT nChannel){
     // WAV 文件头
     WAVFileHeader header;
@@ -167,7 +209,7 @@ void AudioPlayer::wirteWaveHeader(UINT sampleRate, UINT bitDepth, UINT nChannel)
 
 
 
-bool AudioPlayer::startPlay(QString& fileName, UINT deviceID){
+bool AudioPlayer::startPlay(QString& fileName, UINT deviceID, const LoudnessResult* loudness){
     // 0. 记录开始时间
     this->startTime = QTime::currentTime();
 
@@ -177,7 +219,40 @@ bool AudioPlayer::startPlay(QString& fileName, UINT deviceID){
         return false;
     }
 
-    WAVEFORMATEX waveFormat = readWaveHeader();
+    PcmFormat::WaveInfo info;
+    if (!readWaveHeader(fileName, info)) {
+        qDebug() << "invalid wave file";
+        this->ifs.close();
+        this->ifs.clear();
+        return false;
+    }
+
+    // WAVE_FORMAT_EXTENSIBLE 已还原为实际子格式
+    WAVEFORMATEX waveFormat;
+    waveFormat.wFormatTag = info.formatTag;
+    waveFormat.nChannels = info.nChannel;
+    waveFormat.nSamplesPerSec = info.sampleRate;
+    waveFormat.wBitsPerSample = info.bitDepth;
+    waveFormat.nBlockAlign = info.blockAlign;  // 每个采样块的字节数
+    waveFormat.nAvgBytesPerSec = info.byteRate; // 每秒的平均字节数
+    waveFormat.cbSize = 0;                    // 无附加信息
+    this->playFormat = waveFormat;
+
+    // 按已测得的响度(媒体库索引或旁车文件)计算增益, 播放时直接应用, 无需再次分析
+    this->playGain = 0.0;
+    this->hasLoudness = false;
+    if (this->normalize && PcmFormat::isSupported(info)) {
+        // 调用方未提供有效响度(如索引已过期)时, 使用手动分析写入的旁车文件
+        LoudnessResult sidecar;
+        if ((loudness == nullptr || !loudness->valid) && LoudnessScanner::readSidecar(fileName, sidecar)) {
+            loudness = &sidecar;
+        }
+        if (loudness != nullptr && loudness->valid) {
+            this->hasLoudness = true;
+            this->playGain = LoudnessScanner::normalizeGain(*loudness);
+        }
+    }
+    this->playGainLinear = static_cast<float>(std::pow(10.0, this->playGain / 20.0));
     // 打开 WaveOut 设备
     MMRESULT res = waveOutOpen(&this->hWaveOut, deviceID, &waveFormat,
                 reinterpret_cast<DWORD_PTR>(&AudioPlayer::waveOutProc),
@@ -202,12 +277,17 @@ bool AudioPlayer::startPlay(QString& fileName, UINT deviceID){
     this->playWaveHeader_2->dwBufferLength = this->playBlockSize;
     waveOutPrepareHeader(this->hWaveOut, this->playWaveHeader_2, sizeof(WAVEHDR));
 
+    // 解码缓冲区预先分配, 回调中不再分配内存
+    if (this->playGain != 0.0) {
+        this->playSamples.reserve(this->playBlockSize / (waveFormat.wBitsPerSample / 8));
+    }
+
     // 填充第一块数据
-    this->ifs.read(this->playWaveHeader_1->lpData, this->playBlockSize);
-    this->playWaveHeader_1->dwBytesRecorded = this->ifs.gcount();
+    this->playWaveHeader_1->dwBytesRecorded = readPlayData(this->playWaveHeader_1->lpData);
+    applyPlayGain(this->playWaveHeader_1->lpData, this->playWaveHeader_1->dwBytesRecorded);
     // 填充第二块数据
-    this->ifs.read(this->playWaveHeader_2->lpData, this->playBlockSize);
-    this->playWaveHeader_2->dwBytesRecorded = this->ifs.gcount();
+    this->playWaveHeader_2->dwBytesRecorded = readPlayData(this->playWaveHeader_2->lpData);
+    applyPlayGain(this->playWaveHeader_2->lpData, this->playWaveHeader_2->dwBytesRecorded);
 
     /*
     问题： 缓冲区切换时会有轻微卡顿
@@ -266,6 +346,7 @@ void AudioPlayer::stopPlay(){
 
         this->hWaveOut = nullptr;
         this->playBlockSize = 0;
+        this->playDataRemaining = 0;
     }
 }
 
@@ -283,8 +364,8 @@ void AudioPlayer::waveOutProc(
             PWAVEHDR used = reinterpret_cast<PWAVEHDR>(dwParam1);
 
             // 重新填充
-            audioplayer->ifs.read(used->lpData, audioplayer->playBlockSize);
-            used->dwBytesRecorded = audioplayer->ifs.gcount();
+            used->dwBytesRecorded = audioplayer->readPlayData(used->lpData);
+            audioplayer->applyPlayGain(used->lpData, used->dwBytesRecorded);
             used->dwFlags &= ~WHDR_DONE; // 清除 WHDR_DONE 标志位，表示数据已经填充
 
             // 重新加入播放队列
@@ -298,24 +379,43 @@ void AudioPlayer::waveOutProc(
     }
 }
 
-WAVEFORMATEX AudioPlayer::readWaveHeader(){
-    WAVFileHeader header;
-    ZeroMemory(&header, sizeof(WAVFileHeader));
-    // 读取头信息
-    this->ifs.read(reinterpret_cast<char*>(&header), sizeof(WAVFileHeader));
+void AudioPlayer::applyPlayGain(char* data, DWORD bytes){
+    if (this->playGainLinear == 1.0f) {
+        return;
+    }
+    const uint16_t bitDepth = this->playFormat.wBitsPerSample;
+    this->playSamples.resize(bytes / (bitDepth / 8));
+    size_t count = PcmFormat::decodeSamples(data, bytes, this->playFormat.wFormatTag, bitDepth, this->playSamples.data());
+
+    // 增益已按测得的真峰值限制, 这里的削波只防止测量误差导致溢出
+    const float gain = this->playGainLinear;
+    const float ceiling = static_cast<float>(std::pow(10.0, LoudnessScanner::TRUE_PEAK_CEILING / 20.0));
+    float* samples = this->playSamples.data();
+    for (size_t i = 0; i < count; ++i) {
+        samples[i] = std::clamp(samples[i] * gain, -ceiling, ceiling);
+    }
+    PcmFormat::encodeSamples(samples, count, this->playFormat.wFormatTag, bitDepth, data);
+}
 
-    WAVEFORMATEX waveFormat;
-    waveFormat.wFormatTag = header.AudioFormat;  // PCM 格式标志
-    waveFormat.nChannels = header.NumChannels;
-    waveFormat.nSamplesPerSec = header.SampleRate;
-    waveFormat.wBitsPerSample = header.BitsPerSample;
-    waveFormat.nBlockAlign = header.BlockAlign;  // 每个采样块的字节数
-    waveFormat.nAvgBytesPerSec = header.ByteRate; // 每秒的平均字节数
-    waveFormat.cbSize = 0;                    // 无附加信息
+bool AudioPlayer::readWaveHeader(const QString& fileName, PcmFormat::WaveInfo& info){
+    // 与媒体库/响度分析使用同一套块解析, 跳过 LIST 等附加块以及扩展的 fmt 块
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly) || !PcmFormat::readWaveInfo(file, info)) {
+        return false;
+    }
+    this->ifs.seekg(info.dataOffset, std::ios::beg);
+    this->playDataRemaining = info.dataSize;
+
+    // 音频时长(ms), 为了防止溢出, 需要先转换为uint64_t进行计算
+    this->audioDuration = static_cast<uint64_t>(info.dataSize) * 1000 / info.byteRate;
+    return true;
+}
 
-    // 视频时长(ms), 为了防止溢出, 需要先转换为uint64_t进行计算
-    this->audioDuration = static_cast<uint64_t>(header.Subchunk2Size) * 1000 / header.ByteRate;
-    return waveFormat;
+DWORD AudioPlayer::readPlayData(char* data){
+    std::streamsize size = std::min<qint64>(this->playBlockSize, this->playDataRemaining);
+    this->ifs.read(data, size);
+    this->playDataRemaining -= this->ifs.gcount();
+    return static_cast<DWORD>(this->ifs.gcount());
 }
 
 AudioPlayer::AudioPlayer(QObject *parent)
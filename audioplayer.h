@@ -2,6 +2,8 @@
 #define AUDIOPLAYER_H
 
 #include <fstream>
+#include <memory>
+#include <vector>
 #include <windows.h>
 #include <thread>
 #include <mutex>
@@ -11,6 +13,10 @@
 #include <QObject>
 #include <QDir>
 
+#include "loudnessmeter.h"
+#include "pcmformat.h"
+#include "loudnessscanner.h"
+
 class AudioPlayer : public QObject
 {
     Q_OBJECT
@@ -24,6 +30,9 @@ public:
     bool isRecording = false; // 是否正在录制
     bool isPlaying = false; // 是否正在播放
     bool isPausing = false; // 是否暂停
+    bool normalize = false; // 播放时是否按已测得的响度归一化
+    bool hasLoudness = false; // 当前播放的文件是否有可用的响度数据
+    double playGain = 0.0; // 当前播放应用的增益(dB)
 
     bool startRecord(UINT nChannel, UINT bitDepth, UINT sampleRate, UINT deviceID); // 开始录制
     void pauseRecord(); // 暂停录制
@@ -32,8 +41,11 @@ public:
     // 保存wave文件
     void saveWaveFile(QString &fileName); // 保存文件
     void clearData(); // 清除recordBuffer数据
+    // 读取录制中的实时响度(LUFS)与真峰值(dBTP), 未在录制时返回false
+    bool recordLoudness(double& momentary, double& shortTerm, double& integrated, double& truePeak);
 
-    bool startPlay(QString& fileName, UINT deviceID); // 开始播放
+    // 开始播放, loudness 为空或无效时从旁车文件读取响度数据
+    bool startPlay(QString& fileName, UINT deviceID, const LoudnessResult* loudness = nullptr);
     void pausePlay(); // 暂停播放
     void continuePlay(); // 继续播放
     void stopPlay(); // 结束播放
@@ -53,6 +65,8 @@ private:
 
     HWAVEIN hWaveIn;
     HWAVEOUT hWaveOut;
+    WAVEFORMATEX recordFormat; // 录制格式
+    WAVEFORMATEX playFormat; // 播放格式
 
     std::ofstream ofs;
     std::ifstream ifs;
@@ -61,6 +75,14 @@ private:
     PWAVEHDR playWaveHeader_1; // 一号播放缓冲区
     PWAVEHDR playWaveHeader_2; // 二号播放缓冲区
 
+    // 录制时的实时响度表, 在录制回调线程写入, 界面线程读取
+    std::unique_ptr<LoudnessMeter> recordMeter;
+    std::vector<float> recordSamples; // 录制数据解码缓冲区
+    std::mutex meterMutex;
+    qint64 playDataRemaining = 0; // data块中尚未读取的字节数
+    float playGainLinear = 1.0f; // 播放增益(线性)
+    std::vector<float> playSamples; // 播放数据解码缓冲区
+
     // 回调处理录制的音频数据
     static void CALLBACK waveInProc(
         HWAVEIN hwi,
@@ -76,10 +98,17 @@ private:
         DWORD_PTR dwParam1,
         DWORD_PTR dwParam2);
 
+    // 将录制的数据送入实时响度表
+    void measureRecord(const char* data, DWORD bytes);
+    // 对即将播放的数据应用增益并限制真峰值
+    void applyPlayGain(char* data, DWORD bytes);
+
     // 写入wave文件头信息
     void wirteWaveHeader(UINT sampleRate, UINT bitDepth, UINT nChannel);
-    // 读取wave文件头信息, 返回文件格式信息, 填充文件时长数据(ms)
-    WAVEFORMATEX readWaveHeader();
+    // 遍历RIFF块读取wave文件头信息, 将ifs定位到data块起始处, 填充文件时长数据(ms)
+    bool readWaveHeader(const QString& fileName, PcmFormat::WaveInfo& info);
+    // 从data块读取至多一个播放缓冲区的数据, 不越过data块末尾, 返回读取的字节数
+    DWORD readPlayData(char* data);
 
     /*
      * WAV 文件头结构体
@@ -1,10 +1,18 @@
 #include "dialog.h"
 #include "ui_dialog.h"
 
+#include <cmath>
+
+#include <QFileInfo>
+#include <QtConcurrent>
+
+#include "loudnessscanner.h"
+
 
 Dialog::Dialog(QWidget *parent)
     : QDialog(parent)
-    , ui(new Ui::Dialog){
+    , ui(new Ui::Dialog)
+    , libraryModel(library){
 
     ui->setupUi(this);
     timer.setTimerType(Qt::PreciseTimer); // 设置毫秒级别精度
@@ -87,6 +95,7 @@ void Dialog::configSignalAndSlot(){
             }
             this->audioplayer.clearData();
             this->ui->timeLCD->display("00:00:00");
+            this->ui->loudnessLabel->clear();
         } else if (this->audioplayer.isPlaying){ // 正在播放
             this->timer.stop();
             this->audioplayer.stopPlay();
@@ -107,25 +116,104 @@ void Dialog::configSignalAndSlot(){
         } else {
             QString fileName = QFileDialog::getOpenFileName(this, "Open File", "", "WAV Files (*.wav)");
             if (!fileName.isEmpty()) {
-                if (this->audioplayer.startPlay(fileName,
-                                                ui->waveOutDeviceBox->currentData().toInt())){
-                    this->timer.start(refreshInterval); // 1s更新一次计时显示
-                    ui->logBrowser->append("start play");
-                } else {
-                    ui->logBrowser->append("error to start play");
-                }
+                playFile(fileName);
             } else {
                 ui->logBrowser->append("cancle open file");
             }
         }
     });
 
+    connect(ui->libraryBtn, &QPushButton::clicked, this, [this](){
+        if (this->library.isScanning()) {
+            ui->logBrowser->append("library is scanning");
+            return;
+        }
+        QString dir = QFileDialog::getExistingDirectory(this, "Open Library");
+        if (!dir.isEmpty()) {
+            this->library.open(dir);
+            ui->logBrowser->append("open library " + dir + ", "
+                                   + QString::number(this->library.entries().size()) + " files indexed");
+        } else {
+            ui->logBrowser->append("cancle open library");
+        }
+    });
+
+    connect(&this->library, &MediaLibrary::scanFinished, this, [this](int scanned, int total){
+        ui->logBrowser->append(QString("library scan finished, %1 files updated, %2 files total")
+                               .arg(scanned).arg(total));
+    });
+
+    connect(ui->normalizeBox, &QCheckBox::toggled, this, [this](bool checked){
+        this->audioplayer.normalize = checked;
+    });
+
+    // 离线分析选中文件的响度, 结果写入旁车文件, 之后播放时可直接归一化
+    connect(ui->analyzeBtn, &QPushButton::clicked, this, [this](){
+        if (this->analyzeWatcher.isRunning()) {
+            ui->logBrowser->append("is analyzing");
+            return;
+        }
+        QStringList fileNames = QFileDialog::getOpenFileNames(this, "Analyze Loudness", "", "WAV Files (*.wav)");
+        if (fileNames.isEmpty()) {
+            ui->logBrowser->append("cancle analyze");
+            return;
+        }
+        ui->logBrowser->append(QString("analyze %1 file(s)").arg(fileNames.size()));
+        // 文件依次分析, 单个文件内部分块并行
+        this->analyzeWatcher.setFuture(QtConcurrent::run([fileNames](){
+            QStringList logs;
+            for (const QString& fileName: fileNames) {
+                LoudnessResult result = LoudnessScanner::analyzeFile(fileName);
+                if (!result.valid) {
+                    logs.append("error to analyze " + fileName);
+                    continue;
+                }
+                logs.append(QString("%1: %2 LUFS, %3 dBTP")
+                            .arg(QFileInfo(fileName).fileName())
+                            .arg(result.integrated, 0, 'f', 1)
+                            .arg(result.truePeak, 0, 'f', 1));
+                if (!LoudnessScanner::writeSidecar(fileName, result)) {
+                    logs.append("error to save " + LoudnessScanner::sidecarPath(fileName));
+                }
+            }
+            return logs;
+        }));
+    });
+
+    connect(&this->analyzeWatcher, &QFutureWatcher<QStringList>::finished, this, [this](){
+        for (const QString& log: this->analyzeWatcher.result()) {
+            ui->logBrowser->append(log);
+        }
+    });
+
+    // 双击媒体库条目直接播放
+    connect(ui->libraryView, &QTableView::doubleClicked, this, [this](const QModelIndex& index){
+        if (this->audioplayer.isRecording){
+            ui->logBrowser->append("is recording");
+        } else if (this->audioplayer.isPlaying){
+            ui->logBrowser->append("is playing");
+        } else {
+            const LibraryEntry& entry = this->libraryModel.entryAt(index.row());
+            if (!entry.valid) {
+                ui->logBrowser->append("invalid wave file " + entry.path);
+                return;
+            }
+            ui->logBrowser->append(QString("%1: %2 Hz, %3 bit, %4 channel(s)")
+                                   .arg(entry.path).arg(entry.sampleRate)
+                                   .arg(entry.bitDepth).arg(entry.nChannel));
+            // 直接使用索引中的响度, 无需旁车文件
+            LoudnessResult loudness = this->library.loudness(entry);
+            playFile(this->library.absolutePath(entry), &loudness);
+        }
+    });
+
     connect(&this->timer, &QTimer::timeout, ui->timeLCD, [=](){
         if (audioplayer.isRecording) {
             // 已录制时长
             int recorded = this->audioplayer.startTime.msecsTo(QTime::currentTime());
             QTime show = QTime(0, 0, 0, 0) .addMSecs(recorded);
             ui->timeLCD->display(show.toString("hh:mm:ss"));
+            showRecordLoudness();
         } else if (audioplayer.isPlaying) {
             // 已播放时长, 当前时间与开始播放时间之差
             int played = this->audioplayer.startTime.msecsTo(QTime::currentTime());
@@ -147,6 +235,34 @@ void Dialog::configSignalAndSlot(){
     });
 }
 
+void Dialog::playFile(QString fileName, const LoudnessResult* loudness){
+    if (this->audioplayer.startPlay(fileName,
+                                    ui->waveOutDeviceBox->currentData().toInt(), loudness)){
+        this->timer.start(refreshInterval); // 1s更新一次计时显示
+        ui->logBrowser->append("start play");
+        if (this->audioplayer.normalize && !this->audioplayer.hasLoudness) {
+            ui->logBrowser->append("no loudness data, play without normalization");
+        } else if (this->audioplayer.normalize) {
+            ui->logBrowser->append(QString("normalize gain %1 dB").arg(this->audioplayer.playGain, 0, 'f', 1));
+        }
+    } else {
+        ui->logBrowser->append("error to start play");
+    }
+}
+
+void Dialog::showRecordLoudness(){
+    double momentary, shortTerm, integrated, truePeak;
+    if (!this->audioplayer.recordLoudness(momentary, shortTerm, integrated, truePeak)) {
+        ui->loudnessLabel->clear();
+        return;
+    }
+    auto format = [](double loudness){
+        return std::isfinite(loudness) ? QString::number(loudness, 'f', 1) : QString("-inf");
+    };
+    ui->loudnessLabel->setText(QString("M %1  S %2  I %3 LUFS  TP %4 dBTP")
+                               .arg(format(momentary), format(shortTerm), format(integrated), format(truePeak)));
+}
+
 void Dialog::configUI(){
     int iAudioDev = waveInGetNumDevs();    //获取输入设备数量
     for (int i = 0; i < iAudioDev; i++){
@@ -170,9 +286,17 @@ void Dialog::configUI(){
     // 添加验证器, 只允许输入整数
     ui->bitDepthEdit->setValidator(new QIntValidator(ui->bitDepthEdit));
     ui->sampleRateEdit->setValidator(new QIntValidator(ui->bitDepthEdit));
+
+    // 媒体库视图, 固定行高避免大量条目时逐行计算尺寸
+    ui->libraryView->setModel(&this->libraryModel);
+    ui->libraryView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    ui->libraryView->verticalHeader()->hide();
+    ui->libraryView->horizontalHeader()->setSectionResizeMode(LibraryModel::PathColumn, QHeaderView::Stretch);
 }
 
 void Dialog::closeEvent(QCloseEvent *event){
+    // 关闭时不等待媒体库扫描完成
+    this->library.cancelScan();
     if (this->audioplayer.isPlaying) {
         this->audioplayer.stopPlay();
     } else if (this->audioplayer.isRecording) {
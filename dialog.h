@@ -6,8 +6,12 @@
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QDesktopServices>
+#include <QHeaderView>
+#include <QFutureWatcher>
 
 #include "audioplayer.h"
+#include "medialibrary.h"
+#include "librarymodel.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class Dialog; }
@@ -24,6 +28,9 @@ public:
 private:
     Ui::Dialog *ui;
     AudioPlayer audioplayer;
+    MediaLibrary library;
+    LibraryModel libraryModel;
+    QFutureWatcher<QStringList> analyzeWatcher; // 离线响度分析
     QTimer timer;
     // 刷新计时器的时间间隔
     constexpr static int refreshInterval = 1000;
@@ -32,6 +39,10 @@ private:
     void configSignalAndSlot();
     // 添加与设定控件
     void configUI();
+    // 播放指定文件
+    void playFile(QString fileName, const LoudnessResult* loudness = nullptr);
+    // 显示录制中的实时响度
+    void showRecordLoudness();
     // 关闭窗口时释放资源
     void closeEvent(QCloseEvent *event) override;
 };
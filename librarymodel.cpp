@@ -0,0 +1,93 @@
+#include "librarymodel.h"
+
+#include <cmath>
+
+#include <QTime>
+
+int LibraryModel::rowCount(const QModelIndex &parent) const{
+    return parent.isValid() ? 0 : this->library.entries().size();
+}
+
+int LibraryModel::columnCount(const QModelIndex &parent) const{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant LibraryModel::data(const QModelIndex &index, int role) const{
+    if (!index.isValid() || index.row() >= this->library.entries().size()) {
+        return QVariant();
+    }
+    const LibraryEntry& entry = this->library.entries().at(index.row());
+
+    if (role == Qt::ToolTipRole) {
+        return QString(entry.hash.toHex());
+    }
+    if (role == Qt::TextAlignmentRole && index.column() != PathColumn) {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    if (!entry.valid && index.column() != PathColumn) {
+        return index.column() == FormatColumn ? QVariant(QString("invalid")) : QVariant();
+    }
+
+    switch (index.column()) {
+    case PathColumn:
+        return entry.path;
+    case FormatColumn:
+        switch (entry.formatTag) {
+        case 1: return QString("PCM");
+        case 3: return QString("FLOAT");
+        default: return QString("0x%1").arg(entry.formatTag, 4, 16, QChar('0'));
+        }
+    case DurationColumn:
+        return QTime(0, 0, 0, 0).addMSecs(entry.duration).toString("hh:mm:ss");
+    case ChannelColumn:
+        return entry.nChannel;
+    case SampleRateColumn:
+        return entry.sampleRate;
+    case BitDepthColumn:
+        return entry.bitDepth;
+    case PeakColumn:
+        // 以dBFS显示
+        if (entry.peak <= 0.0f) {
+            return QString("-inf");
+        }
+        return QString::number(20.0 * std::log10(entry.peak), 'f', 1);
+    case LoudnessColumn:
+        return std::isfinite(entry.loudness) ? QString::number(entry.loudness, 'f', 1) : QString("-inf");
+    case TruePeakColumn:
+        return std::isfinite(entry.truePeak) ? QString::number(entry.truePeak, 'f', 1) : QString("-inf");
+    }
+    return QVariant();
+}
+
+QVariant LibraryModel::headerData(int section, Qt::Orientation orientation, int role) const{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    switch (section) {
+    case PathColumn: return QString("文件");
+    case FormatColumn: return QString("格式");
+    case DurationColumn: return QString("时长");
+    case ChannelColumn: return QString("声道");
+    case SampleRateColumn: return QString("采样率");
+    case BitDepthColumn: return QString("位深");
+    case PeakColumn: return QString("峰值(dBFS)");
+    case LoudnessColumn: return QString("响度(LUFS)");
+    case TruePeakColumn: return QString("真峰值(dBTP)");
+    }
+    return QVariant();
+}
+
+const LibraryEntry& LibraryModel::entryAt(int row) const{
+    return this->library.entries().at(row);
+}
+
+LibraryModel::LibraryModel(MediaLibrary& library, QObject *parent)
+    : QAbstractTableModel{parent}, library(library){
+    // 条目列表整体替换, 直接重置模型
+    // 必须在替换前开始重置, 视图在 beginResetModel 期间仍可能访问旧条目
+    connect(&this->library, &MediaLibrary::entriesAboutToChange, this, &LibraryModel::beginResetModel);
+    connect(&this->library, &MediaLibrary::entriesChanged, this, &LibraryModel::endResetModel);
+}
@@ -0,0 +1,38 @@
+#ifndef LIBRARYMODEL_H
+#define LIBRARYMODEL_H
+
+#include <QAbstractTableModel>
+
+#include "medialibrary.h"
+
+// 媒体库表格模型, 直接引用 MediaLibrary 的条目列表, 不复制数据
+class LibraryModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    enum Column {
+        PathColumn,
+        FormatColumn,
+        DurationColumn,
+        ChannelColumn,
+        SampleRateColumn,
+        BitDepthColumn,
+        PeakColumn,
+        LoudnessColumn,
+        TruePeakColumn,
+        ColumnCount
+    };
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    const LibraryEntry& entryAt(int row) const;
+
+    explicit LibraryModel(MediaLibrary& library, QObject *parent = nullptr);
+private:
+    MediaLibrary& library;
+};
+
+#endif // LIBRARYMODEL_H
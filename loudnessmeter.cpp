@@ -0,0 +1,318 @@
+#include "loudnessmeter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+
+// 单个采样过一级双二阶滤波器
+inline double filter(double x, double b0, double b1, double b2, double a1, double a2, double& z1, double& z2){
+    double y = b0 * x + z1;
+    z1 = b1 * x - a1 * y + z2;
+    z2 = b2 * x - a2 * y;
+    return y;
+}
+
+}
+
+void LoudnessHistogram::add(double energy){
+    double loudness = LoudnessMeter::energyToLoudness(energy);
+    // 低于绝对门限以及非有限值(损坏文件中的 inf/nan 采样)直接丢弃
+    if (!std::isfinite(loudness) || loudness < MIN_LOUDNESS) {
+        return;
+    }
+    int bin = std::clamp(static_cast<int>((loudness - MIN_LOUDNESS) / BIN_WIDTH), 0, BIN_NUM - 1);
+    ++this->counts[bin];
+    this->energies[bin] += energy;
+}
+
+void LoudnessHistogram::merge(const LoudnessHistogram& other){
+    for (int i = 0; i < BIN_NUM; ++i) {
+        this->counts[i] += other.counts[i];
+        this->energies[i] += other.energies[i];
+    }
+}
+
+double LoudnessHistogram::integrated() const{
+    // 1. 绝对门限以上所有门限块的平均能量, 减 10LU 得到相对门限
+    double sum = 0.0;
+    uint64_t count = 0;
+    for (int i = 0; i < BIN_NUM; ++i) {
+        sum += this->energies[i];
+        count += this->counts[i];
+    }
+    if (count == 0) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    double relativeGate = LoudnessMeter::energyToLoudness(sum / count) - 10.0;
+
+    // 2. 两个门限之上的门限块再次平均, 相对门限所在区间按区间中心取舍
+    int first = std::max(0, static_cast<int>(std::ceil((relativeGate - MIN_LOUDNESS) / BIN_WIDTH - 0.5)));
+    sum = 0.0;
+    count = 0;
+    for (int i = first; i < BIN_NUM; ++i) {
+        sum += this->energies[i];
+        count += this->counts[i];
+    }
+    if (count == 0) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    return LoudnessMeter::energyToLoudness(sum / count);
+}
+
+void LoudnessStats::merge(const LoudnessStats& other){
+    this->histogram.merge(other.histogram);
+    this->samplePeak = std::max(this->samplePeak, other.samplePeak);
+    this->truePeak = std::max(this->truePeak, other.truePeak);
+}
+
+double LoudnessMeter::energyToLoudness(double energy){
+    if (energy <= 0.0) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    return -0.691 + 10.0 * std::log10(energy);
+}
+
+double LoudnessMeter::loudnessToEnergy(double loudness){
+    return std::pow(10.0, (loudness + 0.691) / 10.0);
+}
+
+double LoudnessMeter::toDecibel(double amplitude){
+    if (amplitude <= 0.0) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    return 20.0 * std::log10(amplitude);
+}
+
+uint32_t LoudnessMeter::subBlockFramesFor(uint32_t sampleRate){
+    return std::max<uint32_t>(1, (sampleRate + 5) / 10);
+}
+
+void LoudnessMeter::addFrames(const float* samples, size_t frames){
+    while (frames > 0) {
+        // 每段不跨越子块边界, 也不跨越预热结束位置
+        size_t n = std::min<size_t>(frames, this->subBlockSize - this->subBlockFill);
+        bool counted = this->warmupFrames == 0;
+        if (!counted) {
+            n = std::min(n, this->warmupFrames);
+            this->warmupFrames -= n;
+        }
+
+        this->processSegment(samples, n, counted);
+        this->subBlockFill += n;
+        if (this->subBlockFill == this->subBlockSize) {
+            this->finishSubBlock(counted);
+        }
+
+        samples += n * this->nChannel;
+        frames -= n;
+    }
+}
+
+void LoudnessMeter::setWarmup(size_t frames){
+    this->warmupFrames = frames;
+}
+
+void LoudnessMeter::reset(){
+    for (Channel& channel: this->channels) {
+        channel.shelf.z1 = channel.shelf.z2 = 0.0;
+        channel.highPass.z1 = channel.highPass.z2 = 0.0;
+        channel.energy = 0.0;
+        std::fill(channel.history.begin(), channel.history.end(), 0.0f);
+        channel.historyPos = 0;
+    }
+    this->subBlockFill = 0;
+    this->warmupFrames = 0;
+    this->subBlocks.fill(0.0);
+    this->subBlockCount = 0;
+    this->result = LoudnessStats();
+}
+
+double LoudnessMeter::momentary() const{
+    if (this->subBlockCount < GATING_SUB_BLOCKS) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    return energyToLoudness(this->recentEnergy(GATING_SUB_BLOCKS));
+}
+
+double LoudnessMeter::shortTerm() const{
+    if (this->subBlockCount < GATING_SUB_BLOCKS) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    // 不足3s时以已有数据计算
+    return energyToLoudness(this->recentEnergy(std::min<size_t>(this->subBlockCount, SHORT_TERM_SUB_BLOCKS)));
+}
+
+double LoudnessMeter::integrated() const{
+    return this->result.histogram.integrated();
+}
+
+double LoudnessMeter::truePeak() const{
+    return toDecibel(this->result.truePeak);
+}
+
+double LoudnessMeter::samplePeak() const{
+    return toDecibel(this->result.samplePeak);
+}
+
+uint32_t LoudnessMeter::subBlockFrames() const{
+    return this->subBlockSize;
+}
+
+const LoudnessStats& LoudnessMeter::stats() const{
+    return this->result;
+}
+
+void LoudnessMeter::processSegment(const float* samples, size_t frames, bool counted){
+    this->planar.resize(frames);
+    float* x = this->planar.data();
+
+    for (size_t c = 0; c < this->nChannel; ++c) {
+        Channel& channel = this->channels[c];
+
+        // 1. 解交错为连续的单声道数据, 以下各循环都在连续内存上进行
+        for (size_t i = 0; i < frames; ++i) {
+            x[i] = samples[i * this->nChannel + c];
+        }
+
+        // 2. 采样峰值与真峰值
+        float samplePeak = 0.0f;
+        for (size_t i = 0; i < frames; ++i) {
+            samplePeak = std::max(samplePeak, std::abs(x[i]));
+        }
+        float truePeak = samplePeak;
+        if (this->oversample > 1) {
+            float* history = channel.history.data();
+            const float* coeffs = this->firCoeffs.data();
+            for (size_t i = 0; i < frames; ++i) {
+                // 最新的采样位于窗口起始处
+                channel.historyPos = (channel.historyPos == 0 ? FIR_PHASE_TAPS : channel.historyPos) - 1;
+                history[channel.historyPos] = x[i];
+                history[channel.historyPos + FIR_PHASE_TAPS] = x[i];
+                const float* window = history + channel.historyPos;
+                for (int phase = 0; phase < this->oversample; ++phase) {
+                    const float* h = coeffs + phase * FIR_PHASE_TAPS;
+                    float y = 0.0f;
+                    for (int k = 0; k < FIR_PHASE_TAPS; ++k) {
+                        y += h[k] * window[k];
+                    }
+                    truePeak = std::max(truePeak, std::abs(y));
+                }
+            }
+        }
+        if (counted) {
+            this->result.samplePeak = std::max(this->result.samplePeak, samplePeak);
+            this->result.truePeak = std::max(this->result.truePeak, truePeak);
+        }
+
+        // 3. K加权滤波, 递归滤波器只能逐采样计算, 状态保存在局部变量中
+        Biquad& s = channel.shelf;
+        Biquad& h = channel.highPass;
+        double s1 = s.z1, s2 = s.z2, h1 = h.z1, h2 = h.z2;
+        double energy = 0.0;
+        for (size_t i = 0; i < frames; ++i) {
+            double y = filter(x[i], s.b0, s.b1, s.b2, s.a1, s.a2, s1, s2);
+            y = filter(y, h.b0, h.b1, h.b2, h.a1, h.a2, h1, h2);
+            energy += y * y;
+        }
+        s.z1 = s1; s.z2 = s2; h.z1 = h1; h.z2 = h2;
+        channel.energy += energy;
+    }
+}
+
+void LoudnessMeter::finishSubBlock(bool counted){
+    // 各声道均方值按权重求和
+    double energy = 0.0;
+    for (Channel& channel: this->channels) {
+        energy += channel.weight * channel.energy / this->subBlockSize;
+        channel.energy = 0.0;
+    }
+    this->subBlocks[this->subBlockCount % SHORT_TERM_SUB_BLOCKS] = energy;
+    ++this->subBlockCount;
+    this->subBlockFill = 0;
+
+    // 门限块以 100ms 步进, 相邻门限块重叠 75%
+    if (counted && this->subBlockCount >= GATING_SUB_BLOCKS) {
+        this->result.histogram.add(this->recentEnergy(GATING_SUB_BLOCKS));
+    }
+}
+
+double LoudnessMeter::recentEnergy(size_t num) const{
+    double sum = 0.0;
+    for (size_t i = 1; i <= num; ++i) {
+        sum += this->subBlocks[(this->subBlockCount - i) % SHORT_TERM_SUB_BLOCKS];
+    }
+    return sum / num;
+}
+
+LoudnessMeter::LoudnessMeter(uint32_t sampleRate, uint16_t nChannel)
+    : sampleRate(sampleRate), nChannel(nChannel){
+    this->subBlockSize = subBlockFramesFor(sampleRate);
+
+    // 1. K加权滤波器系数, 按采样率由双线性变换求得 (BS.1770-4, 48kHz 时与标准给出的系数一致)
+    Biquad shelf;
+    {
+        const double f0 = 1681.974450955533;
+        const double gain = 3.999843853973347;
+        const double q = 0.7071752369554196;
+        const double k = std::tan(PI * f0 / sampleRate);
+        const double vh = std::pow(10.0, gain / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+        shelf.b0 = (vh + vb * k / q + k * k) / a0;
+        shelf.b1 = 2.0 * (k * k - vh) / a0;
+        shelf.b2 = (vh - vb * k / q + k * k) / a0;
+        shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+        shelf.a2 = (1.0 - k / q + k * k) / a0;
+    }
+    Biquad highPass;
+    {
+        const double f0 = 38.13547087602444;
+        const double q = 0.5003270373238773;
+        const double k = std::tan(PI * f0 / sampleRate);
+        const double a0 = 1.0 + k / q + k * k;
+        highPass.b0 = 1.0;
+        highPass.b1 = -2.0;
+        highPass.b2 = 1.0;
+        highPass.a1 = 2.0 * (k * k - 1.0) / a0;
+        highPass.a2 = (1.0 - k / q + k * k) / a0;
+    }
+
+    // 2. 真峰值过采样倍数, 采样率越高所需倍数越低
+    this->oversample = sampleRate < 96000 ? 4 : (sampleRate < 192000 ? 2 : 1);
+    if (this->oversample > 1) {
+        // 加汉宁窗的sinc低通, 截止频率为原采样率的奈奎斯特频率, 每个相位归一化为单位增益
+        const int taps = this->oversample * FIR_PHASE_TAPS;
+        const double center = (taps - 1) / 2.0;
+        this->firCoeffs.resize(taps);
+        for (int phase = 0; phase < this->oversample; ++phase) {
+            double sum = 0.0;
+            for (int k = 0; k < FIR_PHASE_TAPS; ++k) {
+                int n = phase + k * this->oversample;
+                double t = (n - center) / this->oversample;
+                double sinc = t == 0.0 ? 1.0 : std::sin(PI * t) / (PI * t);
+                double window = 0.5 - 0.5 * std::cos(2.0 * PI * (n + 1) / (taps + 1));
+                this->firCoeffs[phase * FIR_PHASE_TAPS + k] = static_cast<float>(sinc * window);
+                sum += sinc * window;
+            }
+            for (int k = 0; k < FIR_PHASE_TAPS; ++k) {
+                this->firCoeffs[phase * FIR_PHASE_TAPS + k] /= static_cast<float>(sum);
+            }
+        }
+    }
+
+    // 3. 声道权重, 5.1 声道时 LFE 不计入, 环绕声道加权 1.41
+    this->channels.resize(nChannel);
+    for (size_t c = 0; c < nChannel; ++c) {
+        Channel& channel = this->channels[c];
+        channel.shelf = shelf;
+        channel.highPass = highPass;
+        channel.history.assign(FIR_PHASE_TAPS * 2, 0.0f);
+        if (nChannel == 6) {
+            channel.weight = c == 3 ? 0.0 : (c >= 4 ? 1.41 : 1.0);
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef LOUDNESSMETER_H
+#define LOUDNESSMETER_H
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * 门限直方图
+ *
+ * 以 0.1LU 为间隔统计 400ms 门限块的个数与能量和, 积分响度的绝对门限(-70LUFS)与相对门限(-10LU)
+ * 都可以直接由直方图求出. 分块并行分析时, 各块的直方图相加即为整个文件的直方图.
+ * */
+class LoudnessHistogram
+{
+public:
+    static constexpr double MIN_LOUDNESS = -70.0; // 绝对门限(LUFS)
+    static constexpr double BIN_WIDTH = 0.1;
+    static constexpr int BIN_NUM = 1000; // 覆盖 -70 ~ +30 LUFS
+
+    void add(double energy); // 加入一个门限块的加权均方能量
+    void merge(const LoudnessHistogram& other);
+    double integrated() const; // 积分响度(LUFS), 没有有效门限块时返回 -inf
+private:
+    std::array<uint64_t, BIN_NUM> counts{};
+    std::array<double, BIN_NUM> energies{};
+};
+
+// 可合并的分析结果
+struct LoudnessStats {
+    LoudnessHistogram histogram;
+    float samplePeak = 0.0f; // 采样峰值, 满量程为1.0
+    float truePeak = 0.0f;   // 过采样后的真峰值, 满量程为1.0
+
+    void merge(const LoudnessStats& other);
+};
+
+/*
+ * EBU R128 / ITU-R BS.1770-4 响度表
+ *
+ * 输入交错浮点采样, 经K加权滤波后按 100ms 子块累计能量,
+ * 由最近 4 个子块得到瞬时响度(门限块), 最近 30 个子块得到短期响度;
+ * 真峰值在 96kHz 以下采用 4 倍过采样的多相FIR插值测量.
+ * */
+class LoudnessMeter
+{
+public:
+    static constexpr int GATING_SUB_BLOCKS = 4;     // 400ms 门限块
+    static constexpr int SHORT_TERM_SUB_BLOCKS = 30; // 3s 短期窗口
+
+    // 能量与响度(LUFS)互转
+    static double energyToLoudness(double energy);
+    static double loudnessToEnergy(double loudness);
+    // 线性幅度转换为dB
+    static double toDecibel(double amplitude);
+    // 指定采样率下一个子块(100ms)的帧数
+    static uint32_t subBlockFramesFor(uint32_t sampleRate);
+
+    // 输入交错采样, frames 为帧数
+    void addFrames(const float* samples, size_t frames);
+    // 接下来的 frames 帧只用于建立滤波器与窗口状态, 不计入统计; 应为子块长度的整数倍
+    void setWarmup(size_t frames);
+    void reset();
+
+    double momentary() const; // 最近400ms的响度(LUFS)
+    double shortTerm() const; // 最近3s的响度(LUFS)
+    double integrated() const; // 积分响度(LUFS)
+    double truePeak() const; // 真峰值(dBTP)
+    double samplePeak() const; // 采样峰值(dBFS)
+
+    uint32_t subBlockFrames() const;
+    const LoudnessStats& stats() const;
+
+    LoudnessMeter(uint32_t sampleRate, uint16_t nChannel);
+private:
+    static constexpr int FIR_PHASE_TAPS = 12; // 每个相位的抽头数
+
+    // 双二阶IIR滤波器, 转置直接II型
+    struct Biquad {
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+        double z1 = 0.0, z2 = 0.0;
+    };
+    struct Channel {
+        Biquad shelf;    // K加权第一级: 高架滤波, 模拟头部声学效应
+        Biquad highPass; // K加权第二级: RLB高通
+        double weight = 1.0; // 声道权重
+        double energy = 0.0; // 当前子块的平方和
+        // 过采样历史, 长度为两倍抽头数, 同一采样写两份, 保证任意位置起的窗口连续
+        std::vector<float> history;
+        size_t historyPos = 0;
+    };
+
+    uint32_t sampleRate;
+    uint16_t nChannel;
+    uint32_t subBlockSize; // 子块帧数(100ms)
+    size_t subBlockFill = 0; // 当前子块已累计帧数
+    size_t warmupFrames = 0;
+
+    std::vector<Channel> channels;
+    std::vector<float> planar; // 单声道解交错缓冲区
+    int oversample; // 过采样倍数
+    std::vector<float> firCoeffs; // 按相位排列的插值系数, oversample * FIR_PHASE_TAPS
+
+    std::array<double, SHORT_TERM_SUB_BLOCKS> subBlocks{}; // 最近子块能量的环形缓冲区
+    size_t subBlockCount = 0; // 已完成的子块数
+    LoudnessStats result;
+
+    void processSegment(const float* samples, size_t frames, bool counted);
+    void finishSubBlock(bool counted);
+    double recentEnergy(size_t num) const;
+};
+
+#endif // LOUDNESSMETER_H
@@ -0,0 +1,176 @@
+#include "loudnessscanner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSettings>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include "pcmformat.h"
+
+namespace {
+
+constexpr qint64 READ_BLOCK_SIZE = 1024 * 1024; // 每次读取1MB
+constexpr qint64 MIN_CHUNK_SUB_BLOCKS = 600;    // 每个分块至少60s, 避免预热开销占比过大
+constexpr qint64 WARMUP_SUB_BLOCKS = 13;        // 3个子块填满门限窗口, 另加1s使滤波器稳定
+
+// 分块范围(帧), begin 按子块对齐
+struct Chunk {
+    qint64 begin = 0;
+    qint64 end = 0;
+};
+
+LoudnessStats analyzeChunk(const QString& fileName, const PcmFormat::WaveInfo& info, const Chunk& chunk){
+    LoudnessMeter meter(info.sampleRate, info.nChannel);
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "open file error";
+        return meter.stats();
+    }
+
+    // 从分块起点之前开始读取, 预热部分不计入统计
+    const qint64 warmup = std::min<qint64>(chunk.begin, WARMUP_SUB_BLOCKS * meter.subBlockFrames());
+    meter.setWarmup(warmup);
+    file.seek(info.dataOffset + (chunk.begin - warmup) * info.blockAlign);
+
+    const qint64 blockBytes = std::max<qint64>(READ_BLOCK_SIZE / info.blockAlign, 1) * info.blockAlign;
+    qint64 remaining = (chunk.end - chunk.begin + warmup) * info.blockAlign;
+    std::vector<float> samples;
+    while (remaining > 0) {
+        QByteArray block = file.read(std::min(blockBytes, remaining));
+        if (block.isEmpty()) {
+            break;
+        }
+        samples.resize(block.size() / (info.bitDepth / 8));
+        size_t count = PcmFormat::decodeSamples(block.constData(), block.size(),
+                                                info.formatTag, info.bitDepth, samples.data());
+        meter.addFrames(samples.data(), count / info.nChannel);
+        remaining -= block.size();
+    }
+    return meter.stats();
+}
+
+}
+
+LoudnessResult LoudnessResult::fromStats(const LoudnessStats& stats){
+    LoudnessResult result;
+    result.valid = true;
+    result.integrated = stats.histogram.integrated();
+    result.truePeak = LoudnessMeter::toDecibel(stats.truePeak);
+    result.samplePeak = LoudnessMeter::toDecibel(stats.samplePeak);
+    return result;
+}
+
+LoudnessResult LoudnessScanner::analyzeFile(const QString& fileName){
+    PcmFormat::WaveInfo info;
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qDebug() << "open file error";
+            return LoudnessResult();
+        }
+        if (!PcmFormat::readWaveInfo(file, info) || !PcmFormat::isSupported(info)) {
+            qDebug() << "unsupported wave format";
+            return LoudnessResult();
+        }
+    }
+
+    // 1. 按子块对齐切分, 分块数不超过线程池线程数
+    const qint64 subBlock = LoudnessMeter::subBlockFramesFor(info.sampleRate);
+    const qint64 frames = info.dataSize / info.blockAlign;
+    const qint64 subBlocks = frames / subBlock;
+    const qint64 chunkNum = std::clamp<qint64>(subBlocks / MIN_CHUNK_SUB_BLOCKS, 1,
+                                               QThreadPool::globalInstance()->maxThreadCount());
+    const qint64 chunkSubBlocks = (subBlocks + chunkNum - 1) / chunkNum;
+    QVector<Chunk> chunks;
+    for (qint64 i = 0; i < chunkNum; ++i) {
+        Chunk chunk;
+        chunk.begin = i * chunkSubBlocks * subBlock;
+        // 最后一个分块包含末尾不足一个子块的数据, 保证峰值统计完整
+        chunk.end = i == chunkNum - 1 ? frames : (i + 1) * chunkSubBlocks * subBlock;
+        if (chunk.begin < chunk.end) {
+            chunks.push_back(chunk);
+        }
+    }
+
+    // 2. 并行分析各分块并合并
+    std::function<LoudnessStats(const Chunk&)> analyze = [fileName, info](const Chunk& chunk){
+        return analyzeChunk(fileName, info, chunk);
+    };
+    LoudnessStats stats;
+    for (const LoudnessStats& chunkStats: QtConcurrent::blockingMapped<QVector<LoudnessStats>>(chunks, analyze)) {
+        stats.merge(chunkStats);
+    }
+    return LoudnessResult::fromStats(stats);
+}
+
+QString LoudnessScanner::sidecarPath(const QString& fileName){
+    return fileName + ".loudness";
+}
+
+bool LoudnessScanner::writeSidecar(const QString& fileName, const LoudnessResult& result){
+    if (!result.valid) {
+        return false;
+    }
+    QFileInfo info(fileName);
+    QSettings sidecar(sidecarPath(fileName), QSettings::IniFormat);
+    sidecar.clear();
+    sidecar.beginGroup("loudness");
+    // 记录源文件大小与修改时间, 文件变化后旁车文件失效
+    sidecar.setValue("size", info.size());
+    sidecar.setValue("mtime", info.lastModified().toMSecsSinceEpoch());
+    // 静音文件的响度与峰值为 -inf, 不写入
+    if (std::isfinite(result.integrated)) {
+        sidecar.setValue("integrated", result.integrated);
+        sidecar.setValue("replaygain_track_gain", REPLAYGAIN_REFERENCE - result.integrated);
+    }
+    if (std::isfinite(result.truePeak)) {
+        sidecar.setValue("true_peak", result.truePeak);
+    }
+    if (std::isfinite(result.samplePeak)) {
+        sidecar.setValue("sample_peak", result.samplePeak);
+    }
+    sidecar.endGroup();
+    sidecar.sync();
+    return sidecar.status() == QSettings::NoError;
+}
+
+bool LoudnessScanner::readSidecar(const QString& fileName, LoudnessResult& result){
+    if (!QFile::exists(sidecarPath(fileName))) {
+        return false;
+    }
+    QFileInfo info(fileName);
+    QSettings sidecar(sidecarPath(fileName), QSettings::IniFormat);
+    sidecar.beginGroup("loudness");
+    if (sidecar.value("size").toLongLong() != info.size()
+        || sidecar.value("mtime").toLongLong() != info.lastModified().toMSecsSinceEpoch()) {
+        qDebug() << "loudness sidecar is out of date";
+        return false;
+    }
+    const double silence = -std::numeric_limits<double>::infinity();
+    result.integrated = sidecar.value("integrated", silence).toDouble();
+    result.truePeak = sidecar.value("true_peak", silence).toDouble();
+    result.samplePeak = sidecar.value("sample_peak", silence).toDouble();
+    result.valid = true;
+    return true;
+}
+
+double LoudnessScanner::normalizeGain(const LoudnessResult& result){
+    if (!result.valid || !std::isfinite(result.integrated)) {
+        return 0.0;
+    }
+    double gain = std::min(TARGET_LOUDNESS - result.integrated, MAX_GAIN);
+    // 增益后的真峰值不超过上限
+    if (std::isfinite(result.truePeak)) {
+        gain = std::min(gain, TRUE_PEAK_CEILING - result.truePeak);
+    }
+    return gain;
+}
@@ -0,0 +1,46 @@
+#ifndef LOUDNESSSCANNER_H
+#define LOUDNESSSCANNER_H
+
+#include <QString>
+
+#include "loudnessmeter.h"
+
+// 单个文件的响度分析结果
+struct LoudnessResult {
+    bool valid = false;
+    double integrated = 0.0; // 积分响度(LUFS)
+    double truePeak = 0.0;   // 真峰值(dBTP)
+    double samplePeak = 0.0; // 采样峰值(dBFS)
+
+    static LoudnessResult fromStats(const LoudnessStats& stats);
+};
+
+/*
+ * 离线响度分析
+ *
+ * 将wave文件的data块按100ms子块对齐切分, 各分块在线程池中独立分析后合并门限直方图.
+ * 每个分块先用前面最多1.3s的数据预热滤波器与门限窗口, 因此跨越分块边界的门限块不会丢失,
+ * 结果与顺序分析一致.
+ * 分析结果保存在与音频文件同名的 .loudness 旁车文件中, 播放时直接读取增益, 无需再次分析.
+ * */
+class LoudnessScanner
+{
+public:
+    static constexpr double TARGET_LOUDNESS = -23.0;      // 归一化目标响度, EBU R128
+    static constexpr double TRUE_PEAK_CEILING = -1.0;     // 归一化后允许的最大真峰值(dBTP)
+    static constexpr double REPLAYGAIN_REFERENCE = -18.0; // ReplayGain 2.0 参考响度
+    static constexpr double MAX_GAIN = 20.0;              // 最大提升(dB), 避免放大底噪
+
+    // 分块并行分析整个文件
+    static LoudnessResult analyzeFile(const QString& fileName);
+
+    // 旁车文件读写
+    static QString sidecarPath(const QString& fileName);
+    static bool writeSidecar(const QString& fileName, const LoudnessResult& result);
+    static bool readSidecar(const QString& fileName, LoudnessResult& result);
+
+    // 归一化增益(dB), 受真峰值上限约束
+    static double normalizeGain(const LoudnessResult& result);
+};
+
+#endif // LOUDNESSSCANNER_H
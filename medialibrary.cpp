@@ -0,0 +1,295 @@
+#include "medialibrary.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QHash>
+#include <QCryptographicHash>
+#include <QtConcurrent>
+
+#include "pcmformat.h"
+#include "loudnessmeter.h"
+
+namespace {
+
+constexpr quint32 INDEX_MAGIC = 0x41504C49; // "APLI"
+constexpr quint32 INDEX_VERSION = 2; // 2: 增加响度与真峰值
+constexpr qint64 READ_BLOCK_SIZE = 1024 * 1024; // 解析文件时每次读取1MB
+
+}
+
+QDataStream &operator<<(QDataStream &out, const LibraryEntry &entry){
+    out << entry.path << entry.size << entry.mtime << entry.valid
+        << entry.formatTag << entry.nChannel << entry.sampleRate << entry.bitDepth
+        << entry.duration << entry.peak << entry.loudness << entry.truePeak << entry.hash;
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, LibraryEntry &entry){
+    in >> entry.path >> entry.size >> entry.mtime >> entry.valid
+       >> entry.formatTag >> entry.nChannel >> entry.sampleRate >> entry.bitDepth
+       >> entry.duration >> entry.peak >> entry.loudness >> entry.truePeak >> entry.hash;
+    return in;
+}
+
+bool MediaLibrary::open(const QString& rootPath){
+    if (this->isScanning()) {
+        qDebug() << "library is scanning";
+        return false;
+    }
+
+    this->rootPath = QDir(rootPath).absolutePath();
+    // 先载入已有索引, 界面可立即显示
+    emit entriesAboutToChange();
+    this->libEntries.clear();
+    this->loadIndex();
+    emit entriesChanged();
+
+    // 再在后台增量扫描
+    this->rescan();
+    return true;
+}
+
+void MediaLibrary::rescan(){
+    if (this->rootPath.isEmpty() || this->isScanning()) {
+        return;
+    }
+    this->scanAborted = false;
+    this->scanWatcher.setFuture(QtConcurrent::run(&MediaLibrary::scanTree, this->rootPath, this->libEntries,
+                                                  static_cast<const std::atomic<bool>*>(&this->scanAborted)));
+}
+
+void MediaLibrary::cancelScan(){
+    this->scanAborted = true;
+}
+
+bool MediaLibrary::isScanning() const{
+    return this->scanWatcher.isRunning();
+}
+
+const QVector<LibraryEntry>& MediaLibrary::entries() const{
+    return this->libEntries;
+}
+
+QString MediaLibrary::absolutePath(const LibraryEntry& entry) const{
+    return QDir(this->rootPath).filePath(entry.path);
+}
+
+LoudnessResult MediaLibrary::loudness(const LibraryEntry& entry) const{
+    LoudnessResult result;
+    QFileInfo fileInfo(this->absolutePath(entry));
+    if (!entry.valid || !PcmFormat::isSupported(entry.formatTag, entry.bitDepth)
+        || fileInfo.size() != entry.size || fileInfo.lastModified().toMSecsSinceEpoch() != entry.mtime) {
+        return result;
+    }
+    result.valid = true;
+    result.integrated = entry.loudness;
+    result.truePeak = entry.truePeak;
+    result.samplePeak = LoudnessMeter::toDecibel(entry.peak);
+    return result;
+}
+
+LibraryEntry MediaLibrary::probeFile(const QString& rootPath, const QString& relativePath,
+                                     const std::atomic<bool>* abort){
+    LibraryEntry entry;
+    entry.path = relativePath;
+    // 打开或读取失败时大小与修改时间保持为 -1, 下次扫描会重新解析该文件
+    entry.size = -1;
+    entry.mtime = -1;
+
+    QFile file(QDir(rootPath).filePath(relativePath));
+    QFileInfo fileInfo(file);
+    const qint64 size = fileInfo.size();
+    const qint64 mtime = fileInfo.lastModified().toMSecsSinceEpoch();
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "open file error" << relativePath;
+        return entry;
+    }
+
+    // 1. 读取格式信息, 不是wave文件时记为无效条目, 文件不变则不再解析
+    PcmFormat::WaveInfo info;
+    if (!PcmFormat::readWaveInfo(file, info)) {
+        entry.size = size;
+        entry.mtime = mtime;
+        return entry;
+    }
+    entry.formatTag = info.formatTag;
+    entry.nChannel = info.nChannel;
+    entry.sampleRate = info.sampleRate;
+    entry.bitDepth = info.bitDepth;
+    // 时长(ms), 为了防止溢出, 需要先转换为uint64_t进行计算
+    entry.duration = static_cast<uint64_t>(info.dataSize) * 1000 / info.byteRate;
+
+    // 2. 顺序读取整个文件计算哈希, 同时在data块内测量峰值与响度
+    // 扫描时各文件已在线程池中并行, 单个文件内不再分块
+    // 只为可解码的格式创建响度表, 其余文件的采样率/声道数不可信
+    std::unique_ptr<LoudnessMeter> meter;
+    if (PcmFormat::isSupported(info)) {
+        meter = std::make_unique<LoudnessMeter>(info.sampleRate, info.nChannel);
+    }
+    std::vector<float> samples;
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    file.seek(0);
+    hash.addData(file.read(info.dataOffset));
+    const qint64 alignedBlock = std::max<qint64>(READ_BLOCK_SIZE / info.blockAlign, 1) * info.blockAlign;
+    qint64 remaining = info.dataSize;
+    while (remaining > 0) {
+        if (abort != nullptr && *abort) {
+            return entry;
+        }
+        QByteArray block = file.read(std::min(alignedBlock, remaining));
+        if (block.isEmpty()) {
+            qDebug() << "read file error" << relativePath;
+            return entry;
+        }
+        hash.addData(block);
+        if (meter != nullptr) {
+            samples.resize(block.size() / (info.bitDepth / 8));
+            size_t count = PcmFormat::decodeSamples(block.constData(), block.size(),
+                                                    info.formatTag, info.bitDepth, samples.data());
+            meter->addFrames(samples.data(), count / info.nChannel);
+        }
+        remaining -= block.size();
+    }
+    while (!file.atEnd()) {
+        QByteArray block = file.read(READ_BLOCK_SIZE);
+        if (block.isEmpty()) {
+            qDebug() << "read file error" << relativePath;
+            return entry;
+        }
+        hash.addData(block);
+    }
+    entry.size = size;
+    entry.mtime = mtime;
+    entry.hash = hash.result();
+    entry.valid = true;
+
+    // 响度只记录在索引中, 旁车文件仅由手动分析写入
+    if (meter != nullptr) {
+        entry.peak = meter->stats().samplePeak;
+        entry.loudness = meter->integrated();
+        entry.truePeak = meter->truePeak();
+    }
+    return entry;
+}
+
+bool MediaLibrary::loadIndex(){
+    QFile file(QDir(this->rootPath).filePath(INDEX_FILE_NAME));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+    quint32 magic = 0, version = 0;
+    in >> magic >> version;
+    if (magic != INDEX_MAGIC || version != INDEX_VERSION) {
+        qDebug() << "library index version mismatch, rebuild";
+        return false;
+    }
+    QVector<LibraryEntry> entries;
+    in >> entries;
+    if (in.status() != QDataStream::Ok) {
+        qDebug() << "library index corrupted, rebuild";
+        return false;
+    }
+    this->libEntries = std::move(entries);
+    return true;
+}
+
+bool MediaLibrary::saveIndex(const QString& rootPath, const QVector<LibraryEntry>& entries){
+    // 先写入临时文件再替换, 避免中途失败破坏旧索引
+    QSaveFile file(QDir(rootPath).filePath(INDEX_FILE_NAME));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "save library index error";
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << INDEX_MAGIC << INDEX_VERSION << entries;
+    return file.commit();
+}
+
+MediaLibrary::ScanResult MediaLibrary::scanTree(const QString& rootPath, const QVector<LibraryEntry>& oldEntries,
+                                                const std::atomic<bool>* abort){
+    ScanResult result;
+
+    QHash<QString, const LibraryEntry*> known;
+    known.reserve(oldEntries.size());
+    for (const LibraryEntry& entry: oldEntries) {
+        known.insert(entry.path, &entry);
+    }
+
+    // 1. 遍历目录树, 大小与修改时间都未变化的文件直接沿用旧条目
+    QDir root(rootPath);
+    QStringList changed;
+    QDirIterator it(rootPath, QStringList() << "*.wav", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext() && !*abort) {
+        it.next();
+        QFileInfo info = it.fileInfo();
+        QString relativePath = root.relativeFilePath(info.absoluteFilePath());
+        const LibraryEntry* old = known.value(relativePath, nullptr);
+        if (old != nullptr && old->size == info.size()
+            && old->mtime == info.lastModified().toMSecsSinceEpoch()) {
+            result.entries.push_back(*old);
+        } else {
+            changed.push_back(relativePath);
+        }
+    }
+
+    // 2. 在线程池中并行解析变化的文件
+    // 取消后剩余文件不再打开, 正在解析的文件在下一次读取前返回
+    std::function<LibraryEntry(const QString&)> probe = [rootPath, abort](const QString& relativePath){
+        if (*abort) {
+            return LibraryEntry();
+        }
+        return MediaLibrary::probeFile(rootPath, relativePath, abort);
+    };
+    result.entries += QtConcurrent::blockingMapped<QVector<LibraryEntry>>(changed, probe);
+    result.scanned = changed.size();
+
+    // 已取消的扫描结果不完整, 不写回索引
+    if (*abort) {
+        result.aborted = true;
+        return result;
+    }
+
+    std::sort(result.entries.begin(), result.entries.end(),
+              [](const LibraryEntry& a, const LibraryEntry& b){ return a.path < b.path; });
+
+    // 3. 有变化(新增/修改/删除)时写回索引
+    if (result.scanned > 0 || result.entries.size() != oldEntries.size()) {
+        saveIndex(rootPath, result.entries);
+    }
+    return result;
+}
+
+MediaLibrary::MediaLibrary(QObject *parent)
+    : QObject{parent}{
+    connect(&this->scanWatcher, &QFutureWatcher<ScanResult>::finished, this, [this](){
+        ScanResult result = this->scanWatcher.result();
+        if (result.aborted) {
+            return;
+        }
+        emit entriesAboutToChange();
+        this->libEntries = std::move(result.entries);
+        emit entriesChanged();
+        emit scanFinished(result.scanned, this->libEntries.size());
+    });
+}
+
+MediaLibrary::~MediaLibrary(){
+    // 取消扫描并等待后台线程退出
+    this->cancelScan();
+    this->scanWatcher.waitForFinished();
+}
@@ -0,0 +1,92 @@
+#ifndef MEDIALIBRARY_H
+#define MEDIALIBRARY_H
+
+#include <atomic>
+#include <limits>
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+#include <QDataStream>
+#include <QFutureWatcher>
+
+#include "loudnessscanner.h"
+
+// 媒体库中的一条文件记录, 由扫描时读取的头信息/峰值/响度/哈希组成
+struct LibraryEntry {
+    QString path;             // 相对于库根目录的路径
+    qint64 size = 0;          // 文件大小(字节), 增量扫描依据, 读取失败时为 -1
+    qint64 mtime = 0;         // 最后修改时间(ms), 增量扫描依据, 读取失败时为 -1
+    bool valid = false;       // 是否为可解析的wave文件
+
+    uint16_t formatTag = 0;   // 音频格式, PCM 为 1, IEEE float 为 3
+    uint16_t nChannel = 0;    // 声道数
+    uint32_t sampleRate = 0;  // 采样率
+    uint16_t bitDepth = 0;    // 位深
+    uint32_t duration = 0;    // 音频时长(ms)
+    float peak = 0.0f;        // 采样峰值, 满量程为 1.0
+    float loudness = -std::numeric_limits<float>::infinity(); // 积分响度(LUFS), 静音或无法解码为 -inf
+    float truePeak = -std::numeric_limits<float>::infinity(); // 真峰值(dBTP)
+    QByteArray hash;          // 文件内容哈希(SHA-1)
+};
+
+QDataStream &operator<<(QDataStream &out, const LibraryEntry &entry);
+QDataStream &operator>>(QDataStream &in, LibraryEntry &entry);
+
+/*
+ * 媒体库
+ *
+ * 打开目录时先同步载入目录下的索引文件, 界面可立即显示上次扫描的结果;
+ * 随后在线程池中增量扫描目录树, 只有大小或修改时间变化的文件才会被重新打开解析,
+ * 扫描完毕后写回索引并通知界面刷新.
+ * */
+class MediaLibrary : public QObject
+{
+    Q_OBJECT
+signals:
+    void entriesAboutToChange(); // 条目列表即将被替换, 此时 entries() 仍为旧列表
+    void entriesChanged(); // 条目列表已更新(载入索引或扫描完毕)
+    void scanFinished(int scanned, int total); // 扫描结束, scanned 为重新解析的文件数
+public:
+    // 索引文件名, 存放于库根目录下
+    static constexpr const char* INDEX_FILE_NAME = ".audioplayer_index";
+
+    bool open(const QString& rootPath); // 载入索引并开始增量扫描
+    void rescan(); // 重新增量扫描当前目录
+    void cancelScan(); // 取消后台扫描, 已取消的扫描不写回索引也不更新条目
+    bool isScanning() const;
+
+    const QVector<LibraryEntry>& entries() const;
+    QString absolutePath(const LibraryEntry& entry) const;
+    // 索引中记录的响度, 文件未测量或已变化时返回无效结果
+    LoudnessResult loudness(const LibraryEntry& entry) const;
+
+    // 解析单个文件: 头信息, 峰值, 响度与内容哈希
+    // abort 不为空且被置位时尽快返回无效条目
+    static LibraryEntry probeFile(const QString& rootPath, const QString& relativePath,
+                                  const std::atomic<bool>* abort = nullptr);
+
+    explicit MediaLibrary(QObject *parent = nullptr);
+    ~MediaLibrary();
+private:
+    // 后台扫描结果
+    struct ScanResult {
+        QVector<LibraryEntry> entries;
+        int scanned = 0;
+        bool aborted = false;
+    };
+
+    QString rootPath;
+    QVector<LibraryEntry> libEntries;
+    QFutureWatcher<ScanResult> scanWatcher;
+    std::atomic<bool> scanAborted{false}; // 扫描线程逐文件检查
+
+    bool loadIndex();
+    static bool saveIndex(const QString& rootPath, const QVector<LibraryEntry>& entries);
+    // 在后台线程执行, 对比旧条目并行解析变化的文件
+    static ScanResult scanTree(const QString& rootPath, const QVector<LibraryEntry>& oldEntries,
+                               const std::atomic<bool>* abort);
+};
+
+#endif // MEDIALIBRARY_H
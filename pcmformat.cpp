@@ -0,0 +1,178 @@
+#include "pcmformat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <QByteArray>
+
+namespace PcmFormat {
+
+namespace {
+
+template <typename T>
+T readLE(const char* p){
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void writeLE(char* p, T value){
+    std::memcpy(p, &value, sizeof(T));
+}
+
+// 浮点数量化为有符号整数, 超出满量程的部分截断
+int32_t quantize(float sample, double scale, double maxValue){
+    double value = std::nearbyint(static_cast<double>(sample) * scale);
+    return static_cast<int32_t>(std::clamp(value, -scale, maxValue));
+}
+
+}
+
+bool readWaveInfo(QIODevice& device, WaveInfo& info){
+    const qint64 fileSize = device.size();
+    QByteArray riff = device.read(12);
+    if (riff.size() < 12 || !riff.startsWith("RIFF") || riff.mid(8, 4) != "WAVE") {
+        return false;
+    }
+
+    bool hasFormat = false;
+    while (true) {
+        QByteArray chunk = device.read(8);
+        if (chunk.size() < 8) {
+            return false;
+        }
+        uint32_t chunkSize = readLE<uint32_t>(chunk.constData() + 4);
+        qint64 chunkBegin = device.pos();
+        if (chunk.startsWith("fmt ") && chunkSize >= 16) {
+            QByteArray fmt = device.read(std::min<uint32_t>(chunkSize, 40));
+            if (fmt.size() < 16) {
+                return false;
+            }
+            info.formatTag = readLE<uint16_t>(fmt.constData());
+            info.nChannel = readLE<uint16_t>(fmt.constData() + 2);
+            info.sampleRate = readLE<uint32_t>(fmt.constData() + 4);
+            info.byteRate = readLE<uint32_t>(fmt.constData() + 8);
+            info.blockAlign = readLE<uint16_t>(fmt.constData() + 12);
+            info.bitDepth = readLE<uint16_t>(fmt.constData() + 14);
+            // WAVE_FORMAT_EXTENSIBLE 的实际格式存放于子格式GUID的前两个字节
+            if (info.formatTag == FORMAT_EXTENSIBLE && fmt.size() >= 26) {
+                info.formatTag = readLE<uint16_t>(fmt.constData() + 24);
+            }
+            hasFormat = true;
+        } else if (chunk.startsWith("data") && hasFormat) {
+            info.dataOffset = chunkBegin;
+            info.dataSize = std::min<qint64>(chunkSize, fileSize - chunkBegin);
+            return info.byteRate != 0 && info.blockAlign != 0 && info.nChannel != 0;
+        }
+        // 跳到下一个块, 块按2字节对齐
+        if (!device.seek(chunkBegin + chunkSize + (chunkSize & 1))) {
+            return false;
+        }
+    }
+}
+
+bool isSupported(uint16_t formatTag, uint16_t bitDepth){
+    if (formatTag == FORMAT_PCM) {
+        return bitDepth == 8 || bitDepth == 16 || bitDepth == 24 || bitDepth == 32;
+    }
+    if (formatTag == FORMAT_IEEE_FLOAT) {
+        return bitDepth == 32 || bitDepth == 64;
+    }
+    return false;
+}
+
+bool isSupported(const WaveInfo& info){
+    return isSupported(info.formatTag, info.bitDepth)
+           && info.nChannel >= 1 && info.nChannel <= MAX_CHANNEL
+           && info.sampleRate >= MIN_SAMPLE_RATE && info.sampleRate <= MAX_SAMPLE_RATE
+           && info.blockAlign == info.nChannel * (info.bitDepth / 8)
+           && static_cast<uint64_t>(info.byteRate) == static_cast<uint64_t>(info.sampleRate) * info.blockAlign;
+}
+
+size_t decodeSamples(const char* data, size_t bytes, uint16_t formatTag, uint16_t bitDepth, float* out){
+    if (!isSupported(formatTag, bitDepth)) {
+        return 0;
+    }
+    const size_t count = bytes / (bitDepth / 8);
+    if (formatTag == FORMAT_PCM) {
+        switch (bitDepth) {
+        case 8: // 8位为无符号数
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = (static_cast<uint8_t>(data[i]) - 128) / 128.0f;
+            }
+            break;
+        case 16:
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = readLE<int16_t>(data + i * 2) / 32768.0f;
+            }
+            break;
+        case 24:
+            for (size_t i = 0; i < count; ++i) {
+                // 3字节小端补码, 左移到高位后再算术右移完成符号扩展
+                const char* p = data + i * 3;
+                int32_t value = static_cast<int32_t>((static_cast<uint32_t>(static_cast<uint8_t>(p[0])) << 8)
+                                                     | (static_cast<uint32_t>(static_cast<uint8_t>(p[1])) << 16)
+                                                     | (static_cast<uint32_t>(static_cast<uint8_t>(p[2])) << 24));
+                out[i] = (value >> 8) / 8388608.0f;
+            }
+            break;
+        case 32:
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = static_cast<float>(readLE<int32_t>(data + i * 4) / 2147483648.0);
+            }
+            break;
+        }
+    } else {
+        // 浮点采样可能含有 inf/nan, 会污染递归滤波器状态并原样送到声卡, 替换为静音
+        for (size_t i = 0; i < count; ++i) {
+            float value = bitDepth == 32 ? readLE<float>(data + i * 4)
+                                         : static_cast<float>(readLE<double>(data + i * 8));
+            out[i] = std::isfinite(value) ? value : 0.0f;
+        }
+    }
+    return count;
+}
+
+size_t encodeSamples(const float* samples, size_t count, uint16_t formatTag, uint16_t bitDepth, char* out){
+    if (!isSupported(formatTag, bitDepth)) {
+        return 0;
+    }
+    if (formatTag == FORMAT_PCM) {
+        switch (bitDepth) {
+        case 8:
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = static_cast<char>(quantize(samples[i], 128.0, 127.0) + 128);
+            }
+            break;
+        case 16:
+            for (size_t i = 0; i < count; ++i) {
+                writeLE<int16_t>(out + i * 2, static_cast<int16_t>(quantize(samples[i], 32768.0, 32767.0)));
+            }
+            break;
+        case 24:
+            for (size_t i = 0; i < count; ++i) {
+                int32_t value = quantize(samples[i], 8388608.0, 8388607.0);
+                out[i * 3] = static_cast<char>(value & 0xFF);
+                out[i * 3 + 1] = static_cast<char>((value >> 8) & 0xFF);
+                out[i * 3 + 2] = static_cast<char>((value >> 16) & 0xFF);
+            }
+            break;
+        case 32:
+            for (size_t i = 0; i < count; ++i) {
+                writeLE<int32_t>(out + i * 4, quantize(samples[i], 2147483648.0, 2147483647.0));
+            }
+            break;
+        }
+    } else if (bitDepth == 32) {
+        std::memcpy(out, samples, count * sizeof(float));
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            writeLE<double>(out + i * 8, samples[i]);
+        }
+    }
+    return count;
+}
+
+}
@@ -0,0 +1,47 @@
+#ifndef PCMFORMAT_H
+#define PCMFORMAT_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include <QIODevice>
+
+// wave文件格式解析与采样编解码
+namespace PcmFormat {
+
+constexpr uint16_t FORMAT_PCM = 1;
+constexpr uint16_t FORMAT_IEEE_FLOAT = 3;
+constexpr uint16_t FORMAT_EXTENSIBLE = 0xFFFE;
+
+// 可解码文件的格式范围, 最低采样率需保证K加权高架滤波器(约1682Hz)低于奈奎斯特频率
+constexpr uint32_t MIN_SAMPLE_RATE = 8000;
+constexpr uint32_t MAX_SAMPLE_RATE = 768000;
+constexpr uint16_t MAX_CHANNEL = 32;
+
+// wave文件的格式信息与data块位置
+struct WaveInfo {
+    uint16_t formatTag = 0;   // 音频格式, 已将 WAVE_FORMAT_EXTENSIBLE 还原为实际子格式
+    uint16_t nChannel = 0;    // 声道数
+    uint32_t sampleRate = 0;  // 采样率
+    uint32_t byteRate = 0;    // 每秒的数据量
+    uint16_t blockAlign = 0;  // 每帧字节数
+    uint16_t bitDepth = 0;    // 位深
+    qint64 dataOffset = -1;   // data块数据起始位置
+    qint64 dataSize = 0;      // data块数据大小(已按文件实际大小截断)
+};
+
+// 遍历RIFF块读取格式信息, 结束时设备位置停在data块数据起始处
+bool readWaveInfo(QIODevice& device, WaveInfo& info);
+
+// 是否支持解码该格式
+bool isSupported(uint16_t formatTag, uint16_t bitDepth);
+// 是否支持解码该文件, 同时要求采样紧密排列, 采样率/声道数在合理范围内且与字节率一致
+bool isSupported(const WaveInfo& info);
+
+// 交错采样数据与浮点数(满量程为1.0)互转, 返回处理的采样数
+size_t decodeSamples(const char* data, size_t bytes, uint16_t formatTag, uint16_t bitDepth, float* out);
+size_t encodeSamples(const float* samples, size_t count, uint16_t formatTag, uint16_t bitDepth, char* out);
+
+}
+
+#endif // PCMFORMAT_H